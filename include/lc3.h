@@ -0,0 +1,86 @@
+#ifndef _LC3_H
+#define _LC3_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+//Public interface of libLC3 : everything a host program needs to embed
+//one or more LC3 VMs without going through the command line or the terminal
+
+//only the functions marked LC3_API are exported , the library is built with
+//hidden visibility so its internal helpers never clash with host symbols
+#if defined(_WIN32) && defined(LC3_SHARED)
+#ifdef LC3_EXPORTS
+#define LC3_API __declspec(dllexport)
+#else
+#define LC3_API __declspec(dllimport)
+#endif
+#elif defined(__GNUC__)
+#define LC3_API __attribute__((visibility("default")))
+#else
+#define LC3_API
+#endif
+
+//defining CPU registers for the LC3 VM (indexes for lc3_get_reg/lc3_set_reg)
+enum
+{
+    LC3_R_R0 = 0,
+    LC3_R_R1,
+    LC3_R_R2,
+    LC3_R_R3,
+    LC3_R_R4,
+    LC3_R_R5,
+    LC3_R_R6,
+    LC3_R_R7,
+    LC3_R_PC, /* program counter */
+    LC3_R_COND,
+    LC3_R_COUNT
+};
+
+//returned by the read_char callback when no character is pending
+#define LC3_NO_INPUT (-1)
+
+//reasons for lc3_run to hand control back to the host
+typedef enum
+{
+    LC3_EVENT_BUDGET = 0, /* instruction budget exhausted , vm can keep running */
+    LC3_EVENT_TRAP,       /* a console trap completed (output may be pending) */
+    LC3_EVENT_INPUT,      /* GETC/IN needs a character , rerun once input is available */
+    LC3_EVENT_POLL,       /* the program polled KBSR and no key was pending */
+    LC3_EVENT_HALT,       /* the program executed HALT */
+    LC3_EVENT_ILLEGAL     /* RTI or reserved opcode , PC points past it */
+} lc3_event;
+
+//host callbacks replacing stdin/stdout , any of them can be NULL
+//a NULL read_char never has input and a NULL write discards the output
+typedef struct
+{
+    void* user;
+    //returns the next input character without blocking or LC3_NO_INPUT
+    int (*read_char)(void* user);
+    //receives console output produced by the traps
+    void (*write)(void* user,const char* data,size_t size);
+} lc3_io;
+
+//opaque VM instance , each one owns its own memory and registers
+typedef struct lc3_vm lc3_vm;
+
+//allocates a zeroed VM with PC at 0x3000 , returns NULL on allocation failure
+LC3_API lc3_vm* lc3_create();
+LC3_API void lc3_destroy(lc3_vm* vm);
+//clears memory and registers so the instance can be reused for a new run
+LC3_API void lc3_reset(lc3_vm* vm);
+LC3_API void lc3_set_io(lc3_vm* vm,const lc3_io* io);
+//loads a big-endian LC3 object image (origin word followed by the program)
+//from a memory buffer , returns false if the buffer is too small to hold an origin
+LC3_API bool lc3_load_image(lc3_vm* vm,const void* data,size_t size);
+//same as lc3_load_image but reads the image from a file , also false if it cannot be opened
+LC3_API bool lc3_load_image_file(lc3_vm* vm,const char* image_path);
+//executes at most max_instructions instructions and returns why it stopped
+LC3_API lc3_event lc3_run(lc3_vm* vm,uint32_t max_instructions);
+//register access , r outside [0,LC3_R_COUNT) reads as 0 and writes are ignored
+LC3_API uint16_t lc3_get_reg(const lc3_vm* vm,int r);
+LC3_API void lc3_set_reg(lc3_vm* vm,int r,uint16_t val);
+//raw memory access , bypasses the memory mapped registers
+LC3_API uint16_t lc3_peek(const lc3_vm* vm,uint16_t address);
+LC3_API void lc3_poke(lc3_vm* vm,uint16_t address,uint16_t val);
+#endif
@@ -0,0 +1,26 @@
+#ifndef _CONSOLE_H
+#define _CONSOLE_H
+#ifdef _WIN32
+/* windows only */
+#include <Windows.h>
+#include <conio.h>
+#else
+/* unix only */
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/termios.h>
+#include <sys/mman.h>
+#endif
+#include <stdint.h>
+//terminal handling for the command line front end , libLC3 itself
+//never touches the terminal and talks to the host through lc3_io
+
+// Handling input buffering from terminal (platform specific)
+void disable_input_buffering();
+void restore_input_buffering();
+uint16_t check_key();
+void handle_interrupt(int signal);
+#endif
@@ -1,21 +1,97 @@
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <signal.h>
 
-#include "vmcore.h"
-#include "vm.h"
+#include "lc3.h"
+#include "console.h"
 
-//Defining the VM hardware components globaly
-//not optimal but should do it for the time being
-uint16_t memory[MEMORY_MAX];
-uint16_t reg[R_COUNT];
+//how many instructions to run before handing control back to the front end
+enum {RUN_BUDGET = 1 << 16};
 
+//character read while blocked on a GETC/IN trap , handed to the VM on the next run
+static int pending_key = LC3_NO_INPUT;
+
+static int console_read_char(void* user){
+    if(pending_key != LC3_NO_INPUT){
+        int c = pending_key;
+        pending_key = LC3_NO_INPUT;
+        return c;
+    }
+    if(check_key())
+        return getchar();
+    return LC3_NO_INPUT;
+}
+
+static void console_write(void* user,const char* data,size_t size){
+    fwrite(data,1,size,stdout);
+    fflush(stdout);
+}
+
+static lc3_vm* vm_init(int argc,char** argv){
+
+    //checks the command line arguments and
+    //loads the image into memory if found
+    if (argc < 2){
+        //show usage string
+        printf("lc3 [image-file1] ...\n");
+        return NULL;
+    }
+    lc3_vm* vm = lc3_create();
+    if(!vm){
+        printf("failed to allocate the VM\n");
+        return NULL;
+    }
+    for(int j = 1; j < argc; ++j){
+        if(!lc3_load_image_file(vm,argv[j])){
+            printf("failed to load image: %s\n",argv[j]);
+            lc3_destroy(vm);
+            return NULL;
+        }
+    }
+    lc3_io io = {NULL,console_read_char,console_write};
+    lc3_set_io(vm,&io);
+    //this sets up the console as we like
+    signal(SIGINT, handle_interrupt);
+    disable_input_buffering();
+    return vm;
+}
+
+static void vm_run(lc3_vm* vm){
+    bool running = true;
+    while(running){
+        switch(lc3_run(vm,RUN_BUDGET)){
+            case LC3_EVENT_INPUT:
+                //the program is blocked on the keyboard , wait for a key
+                pending_key = getchar();
+                if(pending_key == EOF)
+                    running = false;
+                break;
+            case LC3_EVENT_HALT:
+                running = false;
+                break;
+            case LC3_EVENT_ILLEGAL:
+                abort();
+            default:
+                break;
+        }
+    }
+}
+
+static bool vm_shutdown(lc3_vm* vm){
+    //this restores the terminal settings back to normal
+    restore_input_buffering();
+    lc3_destroy(vm);
+    printf("VM Shutdown succesfully !\n");
+    return true;
+}
 
 int main(int argc,char* argv[]){
-    if(!vm_init(argc,argv))
+    lc3_vm* vm = vm_init(argc,argv);
+    if(!vm)
         return -1;
-    bool running = true;
-    vm_run(&running);
-    if(!vm_shutdown())
+    vm_run(vm);
+    if(!vm_shutdown(vm))
 	    return -2;
     return 0;
 }
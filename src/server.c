@@ -0,0 +1,665 @@
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "lc3.h"
+
+//Session server : every connection gets its own VM whose console traps and
+//KBSR/KBDR are wired to the connection buffers instead of the terminal.
+//A single epoll loop watches all sockets and hands ready sessions to a small
+//pool of workers , a session waiting for input costs no thread at all.
+//Programs polling KBSR keep running (they may be doing work between polls)
+//but while no key is pending they are parked on EPOLLIN with a retry delay
+//that backs off from POLL_DELAY_MS to POLL_DELAY_MAX_MS , a key wakes them at once.
+
+//instructions per lc3_run call and lc3_run calls per turn on a worker
+//before the session goes back to the end of the queue
+enum {SLICE_BUDGET = 1 << 12, SLICES_PER_TURN = 64};
+//full slices a session may still run once its client hung up and its input is consumed
+enum {HANGUP_SLICES = 256};
+enum {INPUT_MAX = 256, DEFAULT_WORKERS = 4, MAX_EVENTS = 64};
+enum {POLL_DELAY_MS = 10, POLL_DELAY_MAX_MS = 200};
+
+typedef struct session
+{
+    int fd;
+    bool registered; /* fd was added to epoll at least once */
+    bool hangup;     /* client closed its side , no more input will come */
+    bool finished;   /* program stopped , only pending output is left */
+    int hangup_slices; /* full slices run after the hang up with no input left */
+    //KBSR polling backoff , the fields below the delay belong to the epoll loop
+    int poll_delay;    /* ms to wait before rerunning , 0 after fresh input */
+    bool parked;       /* waiting in the poll heap */
+    int64_t poll_due;  /* CLOCK_MONOTONIC ms at which the session reruns */
+    size_t heap_index; /* position in the poll heap while parked */
+    lc3_vm* vm;
+    //bytes received from the client and not yet consumed by the VM
+    unsigned char in[INPUT_MAX];
+    size_t in_start,in_end;
+    //bytes produced by the VM and not yet sent to the client
+    char* out;
+    size_t out_start,out_end,out_cap;
+    struct session* next; /* work queue link */
+} session;
+
+typedef struct
+{
+    unsigned char* data;
+    size_t size;
+} image;
+
+static image* images;
+static int image_count;
+static int epoll_fd = -1;
+static int listen_fd = -1;
+//written by workers to wake the epoll loop when they hand it polling sessions
+static int wake_fd = -1;
+//spare descriptor given up to accept and drop a connection when out of fds
+static int reserve_fd = -1;
+//set when the listener was taken out of epoll because no fd was left at all
+static atomic_bool listener_paused;
+
+//sessions ready to run , owned by whichever worker pops them
+static session* queue_head;
+static session* queue_tail;
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+
+//sessions that polled KBSR with no key pending , handed by the workers to
+//the epoll loop which alone parks them , wakes them and times them out
+static session* poll_head;
+static pthread_mutex_t poll_lock = PTHREAD_MUTEX_INITIALIZER;
+//min-heap on poll_due of the parked sessions , only touched by the epoll loop
+static session** poll_heap;
+static size_t poll_count,poll_cap;
+
+static int64_t now_ms(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void queue_push(session* s){
+    s->next = NULL;
+    pthread_mutex_lock(&queue_lock);
+    if(queue_tail)
+        queue_tail->next = s;
+    else
+        queue_head = s;
+    queue_tail = s;
+    pthread_cond_signal(&queue_cond);
+    pthread_mutex_unlock(&queue_lock);
+}
+
+static session* queue_pop(){
+    pthread_mutex_lock(&queue_lock);
+    while(!queue_head)
+        pthread_cond_wait(&queue_cond,&queue_lock);
+    session* s = queue_head;
+    queue_head = s->next;
+    if(!queue_head)
+        queue_tail = NULL;
+    pthread_mutex_unlock(&queue_lock);
+    return s;
+}
+
+static void poll_push(session* s){
+    pthread_mutex_lock(&poll_lock);
+    bool first = !poll_head;
+    s->next = poll_head;
+    poll_head = s;
+    pthread_mutex_unlock(&poll_lock);
+    //the epoll loop may be sleeping without a timeout , let it adopt the session
+    uint64_t one = 1;
+    if(first && write(wake_fd,&one,sizeof(one)) < 0)
+        return;
+}
+
+static void poll_heap_swap(size_t a,size_t b){
+    session* s = poll_heap[a];
+    poll_heap[a] = poll_heap[b];
+    poll_heap[b] = s;
+    poll_heap[a]->heap_index = a;
+    poll_heap[b]->heap_index = b;
+}
+
+static void poll_heap_up(size_t i){
+    while(i && poll_heap[(i - 1) / 2]->poll_due > poll_heap[i]->poll_due){
+        poll_heap_swap(i,(i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void poll_heap_down(size_t i){
+    for(;;){
+        size_t least = i;
+        size_t left = 2 * i + 1;
+        if(left < poll_count && poll_heap[left]->poll_due < poll_heap[least]->poll_due)
+            least = left;
+        if(left + 1 < poll_count && poll_heap[left + 1]->poll_due < poll_heap[least]->poll_due)
+            least = left + 1;
+        if(least == i)
+            return;
+        poll_heap_swap(i,least);
+        i = least;
+    }
+}
+
+static bool poll_heap_insert(session* s){
+    if(poll_count == poll_cap){
+        size_t cap = poll_cap ? poll_cap * 2 : 64;
+        session** heap = realloc(poll_heap,cap * sizeof(session*));
+        if(!heap)
+            return false;
+        poll_heap = heap;
+        poll_cap = cap;
+    }
+    s->heap_index = poll_count;
+    poll_heap[poll_count++] = s;
+    poll_heap_up(s->heap_index);
+    s->parked = true;
+    return true;
+}
+
+static void poll_heap_remove(session* s){
+    size_t i = s->heap_index;
+    if(i != --poll_count){
+        poll_heap[i] = poll_heap[poll_count];
+        poll_heap[i]->heap_index = i;
+        poll_heap_down(i);
+        poll_heap_up(i);
+    }
+    s->parked = false;
+}
+
+//how long epoll_wait may sleep before the next parked session is due
+static int poll_timeout(){
+    if(!poll_count)
+        return -1;
+    int64_t left = poll_heap[0]->poll_due - now_ms();
+    return left > 0 ? (int)left : 0;
+}
+
+//lc3_io callbacks : the VM only ever sees the session buffers
+static int session_read_char(void* user){
+    session* s = user;
+    if(s->in_start == s->in_end)
+        return LC3_NO_INPUT;
+    return s->in[s->in_start++];
+}
+
+static void session_write(void* user,const char* data,size_t size){
+    session* s = user;
+    if(s->out_end + size > s->out_cap){
+        //move pending bytes to the front before growing the buffer
+        if(s->out_start){
+            memmove(s->out,s->out + s->out_start,s->out_end - s->out_start);
+            s->out_end -= s->out_start;
+            s->out_start = 0;
+        }
+        size_t cap = s->out_cap ? s->out_cap : 1024;
+        while(s->out_end + size > cap)
+            cap *= 2;
+        if(cap != s->out_cap){
+            char* out = realloc(s->out,cap);
+            if(!out)
+                return;
+            s->out = out;
+            s->out_cap = cap;
+        }
+    }
+    memcpy(s->out + s->out_end,data,size);
+    s->out_end += size;
+}
+
+static session* session_create(int fd){
+    session* s = calloc(1,sizeof(session));
+    if(!s)
+        return NULL;
+    s->fd = fd;
+    s->vm = lc3_create();
+    if(!s->vm){
+        free(s);
+        return NULL;
+    }
+    for(int i = 0; i < image_count; ++i){
+        if(!lc3_load_image(s->vm,images[i].data,images[i].size)){
+            lc3_destroy(s->vm);
+            free(s);
+            return NULL;
+        }
+    }
+    lc3_io io = {s,session_read_char,session_write};
+    lc3_set_io(s->vm,&io);
+    return s;
+}
+
+//adds the listening socket to epoll
+static bool listener_watch(int op){
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = &listen_fd; /* marks the listening socket */
+    return epoll_ctl(epoll_fd,op,listen_fd,&ev) == 0;
+}
+
+static void session_close(session* s){
+    //closing the fd also drops it from the epoll set
+    close(s->fd);
+    //a descriptor is free again , resume accepting if we had to stop
+    if(atomic_exchange(&listener_paused,false))
+        listener_watch(EPOLL_CTL_ADD);
+    lc3_destroy(s->vm);
+    free(s->out);
+    free(s);
+}
+
+//reads whatever the client sent without blocking
+//returns false if the socket failed
+static bool session_fill(session* s){
+    if(s->in_start == s->in_end)
+        s->in_start = s->in_end = 0;
+    while(!s->hangup && s->in_end < INPUT_MAX){
+        ssize_t n = recv(s->fd,s->in + s->in_end,INPUT_MAX - s->in_end,0);
+        if(n > 0)
+            s->in_end += (size_t)n;
+        else if(n == 0)
+            s->hangup = true;
+        else if(errno == EINTR)
+            continue;
+        else
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    return true;
+}
+
+//sends pending output without blocking
+//returns false if the socket failed
+static bool session_flush(session* s){
+    while(s->out_start < s->out_end){
+        ssize_t n = send(s->fd,s->out + s->out_start,s->out_end - s->out_start,MSG_NOSIGNAL);
+        if(n > 0)
+            s->out_start += (size_t)n;
+        else if(n < 0 && errno == EINTR)
+            continue;
+        else
+            return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+    s->out_start = s->out_end = 0;
+    return true;
+}
+
+//hands the session back to epoll until its socket is ready for the given events
+//no EPOLLRDHUP : once a client half-closed it would stay ready and wake a
+//session waiting on EPOLLOUT in a loop , a hang up still shows up as EPOLLIN
+static bool session_arm(session* s,uint32_t events){
+    struct epoll_event ev;
+    ev.events = events | EPOLLONESHOT;
+    ev.data.ptr = s;
+    if(s->registered)
+        return epoll_ctl(epoll_fd,EPOLL_CTL_MOD,s->fd,&ev) == 0;
+    s->registered = true;
+    return epoll_ctl(epoll_fd,EPOLL_CTL_ADD,s->fd,&ev) == 0;
+}
+
+//parks the sessions handed over by the workers : they wait on EPOLLIN so a
+//key wakes them right away , and in the heap for their retry delay
+static void poll_adopt(){
+    pthread_mutex_lock(&poll_lock);
+    session* s = poll_head;
+    poll_head = NULL;
+    pthread_mutex_unlock(&poll_lock);
+    int64_t now = now_ms();
+    while(s){
+        session* next = s->next;
+        s->poll_due = now + s->poll_delay;
+        if(!poll_heap_insert(s))
+            queue_push(s);
+        else if(!session_arm(s,EPOLLIN)){
+            poll_heap_remove(s);
+            session_close(s);
+        }
+        s = next;
+    }
+}
+
+//reruns the parked sessions whose delay is over , their fd is dropped from
+//epoll first so a late EPOLLIN can never hand the session out twice
+static void poll_expire(){
+    int64_t now = now_ms();
+    while(poll_count && poll_heap[0]->poll_due <= now){
+        session* s = poll_heap[0];
+        poll_heap_remove(s);
+        epoll_ctl(epoll_fd,EPOLL_CTL_DEL,s->fd,NULL);
+        s->registered = false;
+        queue_push(s);
+    }
+}
+
+//runs one turn of a session on a worker thread , the session is owned by
+//the calling worker until it is armed , queued again or closed
+static void session_service(session* s){
+    if(s->finished){
+        if(session_flush(s) && s->out_start != s->out_end && session_arm(s,EPOLLOUT))
+            return;
+        session_close(s);
+        return;
+    }
+    size_t buffered = s->in_end - s->in_start;
+    if(!session_fill(s)){
+        session_close(s);
+        return;
+    }
+    //fresh input means the program is being used , poll again at full rate
+    if(s->in_end - s->in_start > buffered)
+        s->poll_delay = 0;
+    lc3_event event = LC3_EVENT_BUDGET;
+    //a client that is not reading its output should not make the VM run ahead
+    if(s->out_start == s->out_end){
+        for(int i = 0; i < SLICES_PER_TURN; ++i){
+            event = lc3_run(s->vm,SLICE_BUDGET);
+            if(event == LC3_EVENT_BUDGET && s->hangup && s->in_start == s->in_end &&
+               ++s->hangup_slices > HANGUP_SLICES)
+                break;
+            //KBSR is a status register , a poll never blocks the program
+            if(event == LC3_EVENT_TRAP || event == LC3_EVENT_BUDGET || event == LC3_EVENT_POLL)
+                continue;
+            break;
+        }
+    }
+    if(!session_flush(s)){
+        session_close(s);
+        return;
+    }
+    if(event == LC3_EVENT_HALT || event == LC3_EVENT_ILLEGAL)
+        s->finished = true;
+    //the client is gone and everything it sent was consumed : let the program
+    //finish reacting to the last input for a bounded number of instructions ,
+    //then stop spending worker time on a session nobody can talk to anymore
+    if(s->hangup && s->in_start == s->in_end &&
+       (event == LC3_EVENT_INPUT || event == LC3_EVENT_POLL || s->hangup_slices > HANGUP_SLICES))
+        s->finished = true;
+    bool armed = true;
+    if(s->out_start != s->out_end)
+        armed = session_arm(s,EPOLLOUT);
+    else if(s->finished){
+        session_close(s);
+        return;
+    }
+    else if(event == LC3_EVENT_INPUT)
+        armed = session_arm(s,EPOLLIN);
+    else if(event == LC3_EVENT_POLL){
+        //back off while the program keeps polling with nothing typed
+        s->poll_delay = s->poll_delay ? s->poll_delay * 2 : POLL_DELAY_MS;
+        if(s->poll_delay > POLL_DELAY_MAX_MS)
+            s->poll_delay = POLL_DELAY_MAX_MS;
+        poll_push(s);
+    }
+    else
+        queue_push(s);
+    if(!armed)
+        session_close(s);
+}
+
+static void* worker_main(void* arg){
+    for(;;)
+        session_service(queue_pop());
+    return NULL;
+}
+
+static void accept_sessions(){
+    for(;;){
+        int fd = accept4(listen_fd,NULL,NULL,SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if(fd < 0){
+            if(errno == EINTR || errno == ECONNABORTED)
+                continue;
+            if(errno != EMFILE && errno != ENFILE)
+                return;
+            //the listener is level-triggered , leaving the connection pending
+            //would spin the loop : use the reserve fd to accept and drop it
+            if(reserve_fd >= 0){
+                close(reserve_fd);
+                fd = accept(listen_fd,NULL,NULL);
+                if(fd >= 0)
+                    close(fd);
+                reserve_fd = open("/dev/null",O_RDONLY | O_CLOEXEC);
+                if(fd >= 0)
+                    continue;
+            }
+            //no reserve either : stop watching the listener until a session closes
+            epoll_ctl(epoll_fd,EPOLL_CTL_DEL,listen_fd,NULL);
+            atomic_store(&listener_paused,true);
+            //a session may have closed before the flag was set , if an fd is
+            //free again take it as the new reserve and resume right away
+            if(reserve_fd < 0)
+                reserve_fd = open("/dev/null",O_RDONLY | O_CLOEXEC);
+            if(reserve_fd >= 0 && atomic_exchange(&listener_paused,false))
+                listener_watch(EPOLL_CTL_ADD);
+            return;
+        }
+        int one = 1;
+        //interactive sessions send a few bytes at a time
+        setsockopt(fd,IPPROTO_TCP,TCP_NODELAY,&one,sizeof(one));
+        session* s = session_create(fd);
+        if(!s){
+            close(fd);
+            continue;
+        }
+        //start the program right away , it will park itself on its first read
+        queue_push(s);
+    }
+}
+
+//binds a tcp listener for host:port , the host defaults to loopback so a
+//bare port never exposes the VMs on every interface
+static int open_tcp_listener(const char* host_port){
+    char host[256];
+    const char* colon = strrchr(host_port,':');
+    const char* port_str = colon ? colon + 1 : host_port;
+    size_t host_len = colon ? (size_t)(colon - host_port) : 0;
+    //[::1]:port style ipv6 literals
+    if(host_len >= 2 && host_port[0] == '[' && host_port[host_len - 1] == ']'){
+        host_port++;
+        host_len -= 2;
+    }
+    if(host_len >= sizeof(host))
+        return -1;
+    if(host_len){
+        memcpy(host,host_port,host_len);
+        host[host_len] = '\0';
+    }
+    else
+        strcpy(host,"127.0.0.1");
+    char* end;
+    errno = 0;
+    long port = strtol(port_str,&end,10);
+    if(errno || end == port_str || *end || port < 1 || port > 65535)
+        return -1;
+    char service[8];
+    snprintf(service,sizeof(service),"%ld",port);
+
+    struct addrinfo hints;
+    memset(&hints,0,sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+    struct addrinfo* results;
+    if(getaddrinfo(host,service,&hints,&results) != 0)
+        return -1;
+    int fd = -1;
+    for(struct addrinfo* ai = results; ai && fd < 0; ai = ai->ai_next){
+        fd = socket(ai->ai_family,ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,ai->ai_protocol);
+        if(fd < 0)
+            continue;
+        int one = 1;
+        if(setsockopt(fd,SOL_SOCKET,SO_REUSEADDR,&one,sizeof(one)) < 0 ||
+           bind(fd,ai->ai_addr,ai->ai_addrlen) < 0){
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(results);
+    return fd;
+}
+
+//address is either unix:<path> , tcp:<port> (loopback) or tcp:<host>:<port>
+static int open_listener(const char* address){
+    int fd = -1;
+    if(strncmp(address,"unix:",5) == 0){
+        struct sockaddr_un addr;
+        memset(&addr,0,sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if(strlen(address + 5) >= sizeof(addr.sun_path))
+            return -1;
+        strcpy(addr.sun_path,address + 5);
+        //only replace a stale socket , never delete anything else at that path
+        struct stat st;
+        if(lstat(addr.sun_path,&st) == 0){
+            if(!S_ISSOCK(st.st_mode))
+                return -1;
+            unlink(addr.sun_path);
+        }
+        fd = socket(AF_UNIX,SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,0);
+        if(fd < 0 || bind(fd,(struct sockaddr*)&addr,sizeof(addr)) < 0)
+            goto fail;
+    }
+    else if(strncmp(address,"tcp:",4) == 0){
+        fd = open_tcp_listener(address + 4);
+        if(fd < 0)
+            return -1;
+    }
+    else
+        return -1;
+    if(listen(fd,SOMAXCONN) < 0)
+        goto fail;
+    return fd;
+fail:
+    if(fd >= 0)
+        close(fd);
+    return -1;
+}
+
+//reads a whole image file so every new session can be loaded from memory
+//fails if the file is too short to even hold the origin word
+static bool load_image_buffer(const char* path,image* img){
+    FILE* file = fopen(path,"rb");
+    if(!file)
+        return false;
+    img->data = NULL;
+    img->size = 0;
+    size_t cap = 0;
+    for(;;){
+        if(img->size == cap){
+            cap = cap ? cap * 2 : 4096;
+            unsigned char* data = realloc(img->data,cap);
+            if(!data){
+                fclose(file);
+                return false;
+            }
+            img->data = data;
+        }
+        size_t n = fread(img->data + img->size,1,cap - img->size,file);
+        if(n == 0)
+            break;
+        img->size += n;
+    }
+    fclose(file);
+    return img->size >= 2;
+}
+
+int main(int argc,char* argv[]){
+    int workers = DEFAULT_WORKERS;
+    int arg = 1;
+    if(arg + 1 < argc && strcmp(argv[arg],"-t") == 0){
+        workers = atoi(argv[arg + 1]);
+        arg += 2;
+    }
+    if(argc - arg < 2 || workers < 1){
+        //show usage string
+        printf("lc3_server [-t threads] <unix:path | tcp:[host:]port> [image-file1] ...\n");
+        return -1;
+    }
+    const char* address = argv[arg++];
+    image_count = argc - arg;
+    images = calloc((size_t)image_count,sizeof(image));
+    for(int i = 0; i < image_count; ++i){
+        if(!images || !load_image_buffer(argv[arg + i],&images[i])){
+            printf("failed to load image: %s\n",argv[arg + i]);
+            return -1;
+        }
+    }
+    listen_fd = open_listener(address);
+    if(listen_fd < 0){
+        printf("failed to listen on: %s\n",address);
+        return -1;
+    }
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    reserve_fd = open("/dev/null",O_RDONLY | O_CLOEXEC);
+    struct epoll_event wake_ev;
+    wake_ev.events = EPOLLIN;
+    wake_ev.data.ptr = &wake_fd;
+    wake_fd = eventfd(0,EFD_NONBLOCK | EFD_CLOEXEC);
+    if(epoll_fd < 0 || wake_fd < 0 || !listener_watch(EPOLL_CTL_ADD) ||
+       epoll_ctl(epoll_fd,EPOLL_CTL_ADD,wake_fd,&wake_ev) < 0){
+        printf("failed to set up epoll\n");
+        return -1;
+    }
+    signal(SIGPIPE,SIG_IGN);
+    for(int i = 0; i < workers; ++i){
+        pthread_t thread;
+        if(pthread_create(&thread,NULL,worker_main,NULL) != 0){
+            printf("failed to start worker threads\n");
+            return -1;
+        }
+        pthread_detach(thread);
+    }
+    printf("serving %d image(s) on %s with %d worker(s)\n",image_count,address,workers);
+    fflush(stdout);
+
+    struct epoll_event events[MAX_EVENTS];
+    for(;;){
+        int n = epoll_wait(epoll_fd,events,MAX_EVENTS,poll_timeout());
+        if(n < 0){
+            if(errno == EINTR)
+                continue;
+            printf("epoll_wait failed\n");
+            return -2;
+        }
+        for(int i = 0; i < n; ++i){
+            if(events[i].data.ptr == &listen_fd)
+                accept_sessions();
+            else if(events[i].data.ptr == &wake_fd){
+                //only there to run poll_adopt below , drain the counter
+                uint64_t count;
+                while(read(wake_fd,&count,sizeof(count)) > 0)
+                    ;
+            }
+            else{
+                session* s = events[i].data.ptr;
+                if(s->parked)
+                    poll_heap_remove(s);
+                queue_push(s);
+            }
+        }
+        poll_adopt();
+        poll_expire();
+    }
+    return 0;
+}
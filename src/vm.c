@@ -1,107 +1,71 @@
 #include <stdint.h>
 #include <stdio.h>
-#include <signal.h>
 #include "vm.h"
 #include "vmcore.h"
 
 
-bool vm_init(int argc,char** argv){
-
-    //checks the command line arguments and 
-    //loads the image into memory if found
-    if (argc < 2){
-        //show usage string
-        printf("lc3 [image-file1] ...\n");
-        return false;   
-    }
-    for(int j = 1; j < argc; ++j){
-        if(!read_image(argv[j])){
-            printf("failed to load image: %s\n",argv[j]);
-            return false;
-        }
-    }
-    //this sets up the console as we like 
-    signal(SIGINT, handle_interrupt);
-    disable_input_buffering();
-
-    //since exactly one condition flag should be set at any given time, set the Z flag 
-    reg[R_COND] = FL_ZRO;
-
-    /* set the PC to starting position 
-     0x3000 is the default */
-    enum {PC_START = 0x3000};
-    reg[R_PC] = PC_START;
-
-    return true;
-}
-
-void vm_run(bool* running){
-    while(*running){
+lc3_event lc3_run(lc3_vm* vm,uint32_t max_instructions){
+    vm->kbsr_empty = false;
+    for(uint32_t i = 0; i < max_instructions; ++i){
         //Fethcing the instruction from PC then incrementing it
-        uint16_t instr = mem_read(reg[R_PC]++);
+        uint16_t instr = lc3_mem_read(vm,vm->reg[R_PC]++);
         uint16_t op = instr >> 12;//left 4 bits of the instr is the opcode rest 12 are params
         //executing instruction depending on the opcode
         switch(op){
             case OP_ADD:
-                vm_add(instr);
+                lc3_vm_add(vm,instr);
                 break;
             case OP_AND:
-                vm_and(instr);
+                lc3_vm_and(vm,instr);
                 break;
             case OP_NOT:
-                vm_not(instr);
+                lc3_vm_not(vm,instr);
                 break;
             case OP_BR:
-                vm_br(instr);
+                lc3_vm_br(vm,instr);
                 break;
             case OP_JMP:
-                vm_jmp(instr);
+                lc3_vm_jmp(vm,instr);
                 break;
             case OP_JSR:
-                vm_jsr(instr);
+                lc3_vm_jsr(vm,instr);
                 break;
             case OP_LD:
-                vm_load(instr);
+                lc3_vm_load(vm,instr);
                 break;
             case OP_LDI:
-                vm_load_indirect(instr);
+                lc3_vm_load_indirect(vm,instr);
                 break;
             case OP_LDR:
-                vm_load_register(instr);
+                lc3_vm_load_register(vm,instr);
                 break;
             case OP_LEA:
-                vm_lea(instr);
+                lc3_vm_lea(vm,instr);
                 break;
             case OP_ST:
-                vm_store(instr);
+                lc3_vm_store(vm,instr);
                 break;
             case OP_STI:
-                vm_store_indirect(instr);
+                lc3_vm_store_indirect(vm,instr);
                 break;
             case OP_STR:
-                vm_store_register(instr);
+                lc3_vm_store_register(vm,instr);
                 break;
             case OP_TRAP:
-                vm_trap(instr,running);
-                break;
+                return lc3_vm_trap(vm,instr);
             case OP_RES:
-                abort();
             case OP_RTI:
-                abort();
             default:
-                abort();
-                break;
+                return LC3_EVENT_ILLEGAL;
         }
+        //a program polling KBSR with no key pending is waiting on the host
+        if(vm->kbsr_empty)
+            return LC3_EVENT_POLL;
     }
-}
-bool vm_shutdown(){
-    //this restores the terminal settings back to normal
-    restore_input_buffering();
-    printf("VM Shutdown succesfully !\n");
-    return true;
+    return LC3_EVENT_BUDGET;
 }
 
-void vm_add(uint16_t instr){
+void lc3_vm_add(lc3_vm* vm,uint16_t instr){
     //register for the DR
     uint16_t r0 = (instr >> 9) & 0x7;
     //first operand (param)
@@ -109,25 +73,25 @@ void vm_add(uint16_t instr){
     //check for the immediate flag
     uint16_t imm_flag = (instr >> 5) & 0x1;
     if(imm_flag){
-        uint16_t imm5 = sign_extend(instr & 0x1F,5);
-        reg[r0] = reg[r1] + imm5;
+        uint16_t imm5 = lc3_sign_extend(instr & 0x1F,5);
+        vm->reg[r0] = vm->reg[r1] + imm5;
     }
     else{
         uint16_t r2 = instr & 0x7;
-        reg[r0] = reg[r1] + reg[r2];
+        vm->reg[r0] = vm->reg[r1] + vm->reg[r2];
     }
-    update_flags(r0);
+    lc3_update_flags(vm,r0);
 }
 
-void vm_not(uint16_t instr){
+void lc3_vm_not(lc3_vm* vm,uint16_t instr){
     //DR
     uint16_t r0 = (instr >> 9) & 0x7;
     //SR
     uint16_t r1 = (instr >> 6) & 0x7;
-    reg[r0] = ~reg[r1];
-    update_flags(r0);
+    vm->reg[r0] = ~vm->reg[r1];
+    lc3_update_flags(vm,r0);
 }
-void vm_and(uint16_t instr){
+void lc3_vm_and(lc3_vm* vm,uint16_t instr){
     //get DR
     uint16_t r0 = (instr >> 9) & 0x7;
     //get R1
@@ -135,170 +99,204 @@ void vm_and(uint16_t instr){
     //get immediate flag
     uint16_t imm_flag =(instr >> 5) & 0x1;
     if(imm_flag){
-        uint16_t imm5 = sign_extend(instr & 0x1F,5);
-        reg[r0] = reg[r1] & imm5;
+        uint16_t imm5 = lc3_sign_extend(instr & 0x1F,5);
+        vm->reg[r0] = vm->reg[r1] & imm5;
     }
     else{
         uint16_t r2 = instr & 0x7;
-        reg[r0] = reg[r1] & reg[r2];
+        vm->reg[r0] = vm->reg[r1] & vm->reg[r2];
     }
-    update_flags(r0);
+    lc3_update_flags(vm,r0);
 }
 
-void vm_br(uint16_t instr){
-    uint16_t pc_offset = sign_extend(instr & 0x1FF,9);
+void lc3_vm_br(lc3_vm* vm,uint16_t instr){
+    uint16_t pc_offset = lc3_sign_extend(instr & 0x1FF,9);
     uint16_t cond_flag = (instr >> 9) & 0x7;
-    if(cond_flag & reg[R_COND])
-        reg[R_PC] += pc_offset;
+    if(cond_flag & vm->reg[R_COND])
+        vm->reg[R_PC] += pc_offset;
 }
 
-void vm_jmp(uint16_t instr){
+void lc3_vm_jmp(lc3_vm* vm,uint16_t instr){
     //get baseR
     uint16_t r0=(instr >> 6) & 0x7;
-    reg[R_PC] = reg[r0];
+    vm->reg[R_PC] = vm->reg[r0];
 }
 
-void vm_jsr(uint16_t instr){
+void lc3_vm_jsr(lc3_vm* vm,uint16_t instr){
     //save the program counter before change to recall it later
-    reg[R_R7] = reg[R_PC];
+    vm->reg[R_R7] = vm->reg[R_PC];
     uint16_t offset_flag = (instr >> 11) & 0x1;
     if(offset_flag){
         //sign extending the offset value
-        uint16_t pc_offset = sign_extend(instr & 0x7FF,11);
-        reg[R_PC] += pc_offset;
+        uint16_t pc_offset = lc3_sign_extend(instr & 0x7FF,11);
+        vm->reg[R_PC] += pc_offset;
     }
     else{
         // obtaining baseR register
         uint16_t r0 = (instr >> 6) & 0x7;
-        reg[R_PC] = reg[r0];
+        vm->reg[R_PC] = vm->reg[r0];
     }
 }
 
-void vm_load(uint16_t instr){
+void lc3_vm_load(lc3_vm* vm,uint16_t instr){
     uint16_t r0 = (instr >> 9) & 0x7;
-    uint16_t pc_offset = sign_extend(instr & 0x1FF,9);
-    reg[r0] = mem_read(reg[R_PC] + pc_offset);
-    update_flags(r0);
+    uint16_t pc_offset = lc3_sign_extend(instr & 0x1FF,9);
+    vm->reg[r0] = lc3_mem_read(vm,vm->reg[R_PC] + pc_offset);
+    lc3_update_flags(vm,r0);
 }
 
-void vm_load_indirect(uint16_t instr){
+void lc3_vm_load_indirect(lc3_vm* vm,uint16_t instr){
     // the DR register
     uint16_t r0 = (instr >> 9) & 0x7;
     // offset of memory address from PC
-    uint16_t pc_offset = sign_extend(instr & 0x1FF , 9);
+    uint16_t pc_offset = lc3_sign_extend(instr & 0x1FF , 9);
     //next line can be thought of as dereferencing a double pointer
-    reg[r0] = mem_read(mem_read(reg[R_PC] + pc_offset));
-    update_flags(r0);
+    vm->reg[r0] = lc3_mem_read(vm,lc3_mem_read(vm,vm->reg[R_PC] + pc_offset));
+    lc3_update_flags(vm,r0);
 }
 
-void vm_load_register(uint16_t instr){
+void lc3_vm_load_register(lc3_vm* vm,uint16_t instr){
     //DR
     uint16_t r0 = (instr >> 9) & 0x7;
     //baseR
     uint16_t r1 = (instr >> 6) & 0x7;
-    uint16_t offset = sign_extend(instr & 0x3F,6);
-    reg[r0] = mem_read(reg[r1] + offset);
-    update_flags(r0);
+    uint16_t offset = lc3_sign_extend(instr & 0x3F,6);
+    vm->reg[r0] = lc3_mem_read(vm,vm->reg[r1] + offset);
+    lc3_update_flags(vm,r0);
 }
 
-void vm_lea(uint16_t instr){
+void lc3_vm_lea(lc3_vm* vm,uint16_t instr){
     //DR
     uint16_t r0 = (instr >> 9) & 0x7;
-    uint16_t pc_offset = sign_extend(instr & 0x1FF,9);
-    reg[r0] = reg[R_PC] + pc_offset;
-    update_flags(r0);
+    uint16_t pc_offset = lc3_sign_extend(instr & 0x1FF,9);
+    vm->reg[r0] = vm->reg[R_PC] + pc_offset;
+    lc3_update_flags(vm,r0);
 }
 
-void vm_store(uint16_t instr){
+void lc3_vm_store(lc3_vm* vm,uint16_t instr){
     //SR
     uint16_t r0 = (instr >> 9) & 0x7;
-    uint16_t pc_offset= sign_extend(instr & 0x1FF,9);
-    mem_write(reg[R_PC] + pc_offset , reg[r0]);
+    uint16_t pc_offset= lc3_sign_extend(instr & 0x1FF,9);
+    lc3_mem_write(vm,vm->reg[R_PC] + pc_offset , vm->reg[r0]);
 }
 
-void vm_store_indirect(uint16_t instr){
+void lc3_vm_store_indirect(lc3_vm* vm,uint16_t instr){
     //SR
     uint16_t r0 = (instr >> 9) & 0x7;
-    uint16_t pc_offset = sign_extend(instr & 0x1FF,9);
-    mem_write(mem_read(reg[R_PC] + pc_offset),reg[r0]);
+    uint16_t pc_offset = lc3_sign_extend(instr & 0x1FF,9);
+    lc3_mem_write(vm,lc3_mem_read(vm,vm->reg[R_PC] + pc_offset),vm->reg[r0]);
 }
 
-void vm_store_register(uint16_t instr){
+void lc3_vm_store_register(lc3_vm* vm,uint16_t instr){
     //SR
     uint16_t r0 = (instr >> 9) & 0x7;
     //baseR
     uint16_t r1 = (instr >> 6) & 0x7;
-    uint16_t offset = sign_extend(instr & 0x3F,6);
-    mem_write(reg[r1] + offset,reg[r0]);
+    uint16_t offset = lc3_sign_extend(instr & 0x3F,6);
+    lc3_mem_write(vm,vm->reg[r1] + offset,vm->reg[r0]);
 }
 
-void vm_trap_getc(){
-    reg[R_R0] =(uint16_t)getchar();
-    update_flags(R_R0);
+//output traps gather characters here before handing them to the host
+//so the write callback is not invoked once per character
+enum {OUT_CHUNK = 128};
+
+bool lc3_vm_trap_getc(lc3_vm* vm){
+    int c = lc3_vm_read_char(vm);
+    if(c == LC3_NO_INPUT)
+        return false;
+    vm->reg[R_R0] =(uint16_t)c;
+    lc3_update_flags(vm,R_R0);
+    return true;
 }
 
-void vm_trap_out(){
-    putc((char)reg[R_R0],stdout);
-    fflush(stdout);
+void lc3_vm_trap_out(lc3_vm* vm){
+    char c = (char)vm->reg[R_R0];
+    lc3_vm_write(vm,&c,1);
 }
 
-void vm_trap_puts(){
-    uint16_t* c = memory + reg[R_R0];
-    while(*c)
-        putc((char)*c++,stdout);//could be an error
-    fflush(stdout);
-    
+void lc3_vm_trap_puts(lc3_vm* vm){
+    char buf[OUT_CHUNK];
+    size_t len = 0;
+    uint16_t address = vm->reg[R_R0];
+    while(vm->memory[address]){
+        buf[len++] = (char)vm->memory[address++];//could be an error
+        if(len == OUT_CHUNK){
+            lc3_vm_write(vm,buf,len);
+            len = 0;
+        }
+    }
+    lc3_vm_write(vm,buf,len);
 }
 
-void vm_trap_in(){
-    printf("Enter a Character : ");
-    char c =(char)getchar();
-    putc(c,stdout);
-    fflush(stdout);
-    reg[R_R0] = (uint16_t)c;
-    update_flags(R_R0);
+bool lc3_vm_trap_in(lc3_vm* vm){
+    if(!vm->in_prompted){
+        static const char prompt[] = "Enter a Character : ";
+        lc3_vm_write(vm,prompt,sizeof(prompt) - 1);
+        vm->in_prompted = true;
+    }
+    int ch = lc3_vm_read_char(vm);
+    if(ch == LC3_NO_INPUT)
+        return false;
+    vm->in_prompted = false;
+    char c = (char)ch;
+    lc3_vm_write(vm,&c,1);
+    vm->reg[R_R0] = (uint16_t)c;
+    lc3_update_flags(vm,R_R0);
+    return true;
 }
 
-void vm_trap_putsp(){
-    uint16_t* address = memory + reg[R_R0];
-    while(*address){
-        char c1 = *address & 0xFF;
-        char c2 = *address >> 8;
-        putc(c1,stdout);
+void lc3_vm_trap_putsp(lc3_vm* vm){
+    char buf[OUT_CHUNK];
+    size_t len = 0;
+    uint16_t address = vm->reg[R_R0];
+    while(vm->memory[address]){
+        char c1 = vm->memory[address] & 0xFF;
+        char c2 = vm->memory[address] >> 8;
+        buf[len++] = c1;
         if(c2)
-            putc(c2,stdout);
+            buf[len++] = c2;
         else
             break;
         address++;
+        if(len >= OUT_CHUNK - 1){
+            lc3_vm_write(vm,buf,len);
+            len = 0;
+        }
     }
-    fflush(stdout);
+    lc3_vm_write(vm,buf,len);
 }
-void vm_trap_halt(){
-    puts("VM Halted");
-    fflush(stdout);
+void lc3_vm_trap_halt(lc3_vm* vm){
+    static const char msg[] = "VM Halted\n";
+    lc3_vm_write(vm,msg,sizeof(msg) - 1);
 }
 
-void vm_trap(uint16_t instr,bool* running){
-    reg[R_R7] = reg[R_PC];
+lc3_event lc3_vm_trap(lc3_vm* vm,uint16_t instr){
+    vm->reg[R_R7] = vm->reg[R_PC];
     switch(instr & 0xFF){
         case TRAP_GETC:
-            vm_trap_getc();
-            break;
+            if(!lc3_vm_trap_getc(vm))
+                break;
+            return LC3_EVENT_TRAP;
         case TRAP_OUT:
-            vm_trap_out();
-            break;
+            lc3_vm_trap_out(vm);
+            return LC3_EVENT_TRAP;
         case TRAP_PUTS:
-            vm_trap_puts();
-            break;
+            lc3_vm_trap_puts(vm);
+            return LC3_EVENT_TRAP;
         case TRAP_IN:
-            vm_trap_in();
-            break;
+            if(!lc3_vm_trap_in(vm))
+                break;
+            return LC3_EVENT_TRAP;
         case TRAP_PUTSP:
-            vm_trap_putsp();
-            break;
+            lc3_vm_trap_putsp(vm);
+            return LC3_EVENT_TRAP;
         case TRAP_HALT:
-            vm_trap_halt();
-            *running = 0;
-            break;
+            lc3_vm_trap_halt(vm);
+            return LC3_EVENT_HALT;
+        default:
+            return LC3_EVENT_TRAP;
     }
+    //no input available yet : rewind so the trap is retried on the next run
+    vm->reg[R_PC]--;
+    return LC3_EVENT_INPUT;
 }
@@ -1,124 +1,144 @@
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "vmcore.h"
 
-#ifdef _WIN32
-HANDLE hStdin = INVALID_HANDLE_VALUE;
-DWORD fdwMode, fdwOldMode;
+uint16_t lc3_sign_extend(uint16_t x , int bit_count){
+    if((x >> (bit_count - 1)) & 1)
+        x|=(0xFFFF << bit_count);
+    return x;
+}
 
-void disable_input_buffering()
-{
-    hStdin = GetStdHandle(STD_INPUT_HANDLE);
-    GetConsoleMode(hStdin, &fdwOldMode); /* save old mode */
-    fdwMode = fdwOldMode
-            ^ ENABLE_ECHO_INPUT  /* no input echo */
-            ^ ENABLE_LINE_INPUT; /* return when one or
-                                    more characters are available */
-    SetConsoleMode(hStdin, fdwMode); /* set new mode */
-    FlushConsoleInputBuffer(hStdin); /* clear buffer */
+void lc3_update_flags(lc3_vm* vm,uint16_t r){
+    if(vm->reg[r] == 0)
+        vm->reg[R_COND] = FL_ZRO;
+    else if(vm->reg[r] >> 15)
+        vm->reg[R_COND] = FL_NEG;
+    else
+        vm->reg[R_COND] = FL_POS;
 }
 
-void restore_input_buffering()
-{
-    SetConsoleMode(hStdin, fdwOldMode);
+void lc3_mem_write(lc3_vm* vm,uint16_t address,uint16_t val){
+    vm->memory[address] = val;
 }
 
-uint16_t check_key()
-{
-    return WaitForSingleObject(hStdin, 1000) == WAIT_OBJECT_0 && _kbhit();
+uint16_t lc3_mem_read(lc3_vm* vm,uint16_t address){
+    if(address == MR_KBSR){
+        int c = lc3_vm_read_char(vm);
+        if(c != LC3_NO_INPUT){
+            vm->memory[MR_KBSR] = (1 << 15);
+            vm->memory[MR_KBDR] = (uint16_t)c;
+        }
+        else{
+            vm->memory[MR_KBSR] = 0;
+            vm->kbsr_empty = true;
+        }
+    }
+    return vm->memory[address];
 }
-#else
-struct termios original_tio;
 
-void disable_input_buffering()
-{
-    tcgetattr(STDIN_FILENO, &original_tio);
-    struct termios new_tio = original_tio;
-    new_tio.c_lflag &=(tcflag_t)~ICANON & (tcflag_t)~ECHO;
-    tcsetattr(STDIN_FILENO, TCSANOW, &new_tio);
+void lc3_vm_write(lc3_vm* vm,const char* data,size_t size){
+    if(vm->io.write && size)
+        vm->io.write(vm->io.user,data,size);
 }
 
-void restore_input_buffering()
-{
-    tcsetattr(STDIN_FILENO, TCSANOW, &original_tio);
+int lc3_vm_read_char(lc3_vm* vm){
+    if(!vm->io.read_char)
+        return LC3_NO_INPUT;
+    return vm->io.read_char(vm->io.user);
 }
 
-uint16_t check_key()
-{
-    fd_set readfds;
-    FD_ZERO(&readfds);
-    FD_SET(STDIN_FILENO, &readfds);
+static void reset_registers(lc3_vm* vm){
+    memset(vm->reg,0,sizeof(vm->reg));
+    vm->in_prompted = false;
+    vm->kbsr_empty = false;
+    //since exactly one condition flag should be set at any given time, set the Z flag 
+    vm->reg[R_COND] = FL_ZRO;
 
-    struct timeval timeout;
-    timeout.tv_sec = 0;
-    timeout.tv_usec = 0;
-    return select(1, &readfds, NULL, NULL, &timeout) != 0;
+    /* set the PC to starting position 
+     0x3000 is the default */
+    enum {PC_START = 0x3000};
+    vm->reg[R_PC] = PC_START;
 }
-#endif
 
-void handle_interrupt(int signal)
-{
-    restore_input_buffering();
-    printf("\n");
-    exit(-2);
+lc3_vm* lc3_create(){
+    //calloc rather than malloc + memset so the pages of memory the program
+    //never touches are not backed until used , which matters with many VMs
+    lc3_vm* vm = calloc(1,sizeof(lc3_vm));
+    if(!vm)
+        return NULL;
+    reset_registers(vm);
+    return vm;
 }
 
-uint16_t sign_extend(uint16_t x , int bit_count){
-    if((x >> (bit_count - 1)) & 1)
-        x|=(0xFFFF << bit_count);
-    return x;
+void lc3_destroy(lc3_vm* vm){
+    free(vm);
 }
 
-void update_flags(uint16_t r){
-    if(reg[r] == 0)
-        reg[R_COND] = FL_ZRO;
-    else if(reg[r] >> 15)
-        reg[R_COND] = FL_NEG;
-    else
-        reg[R_COND] = FL_POS;
+void lc3_reset(lc3_vm* vm){
+    memset(vm->memory,0,sizeof(vm->memory));
+    reset_registers(vm);
 }
 
-void mem_write(uint16_t address,uint16_t val){
-    memory[address] = val;
+void lc3_set_io(lc3_vm* vm,const lc3_io* io){
+    if(io)
+        vm->io = *io;
+    else
+        memset(&vm->io,0,sizeof(vm->io));
 }
 
-uint16_t mem_read(uint16_t address){
-    if(address == MR_KBSR){
-        if(check_key()){
-            memory[MR_KBSR] = (1 << 15);
-            memory[MR_KBDR] = (uint16_t)getchar();
-        }
-        else
-            memory[MR_KBSR] = 0;
-    }
-    return memory[address];
-}
-
-uint16_t swap16(uint16_t x){
-    return (uint16_t)(x << 8) | (x >> 8);
-}
-
-void read_image_file(FILE* file){
-    /* the origin tells us where in memory to place the image */
-    uint16_t origin;
-    fread(&origin,sizeof(origin),1,file);
-    origin = swap16(origin);
-    /* we know the maximum file size so we only need one fread */
-    uint16_t max_read =(uint16_t)MEMORY_MAX - origin;
-    //get the memory where the binary of the program should be copied to
-    uint16_t* p = memory + origin;
-    //get how many 16-bits have been read and copied to p
-    size_t read =fread(p,sizeof(uint16_t),max_read,file);
-    while(read-- > 0){
-        *p = swap16(*p);
-        ++p;
-    }
+bool lc3_load_image(lc3_vm* vm,const void* data,size_t size){
+    const uint8_t* bytes = data;
+    if(size < 2)
+        return false;
+    //the image is big-endian so words are assembled byte by byte
+    //which also keeps this independent from the host endianness
+    uint16_t origin = (uint16_t)(bytes[0] << 8 | bytes[1]);
+    size_t count = (size - 2) / 2;
+    if(count > (size_t)MEMORY_MAX - origin)
+        count = (size_t)MEMORY_MAX - origin;
+    bytes += 2;
+    for(size_t i = 0; i < count; ++i)
+        vm->memory[origin + i] = (uint16_t)(bytes[2 * i] << 8 | bytes[2 * i + 1]);
+    return true;
 }
-int read_image(const char* image_path){
+
+bool lc3_load_image_file(lc3_vm* vm,const char* image_path){
     FILE* file = fopen(image_path,"rb");
     if(!file)
-        return 0;
-    read_image_file(file);
+        return false;
+    //the origin word plus a full memory is the most an image can ever place ,
+    //reading it into a buffer gives files the same checks as lc3_load_image
+    size_t max_size = 2 + 2 * (size_t)MEMORY_MAX;
+    uint8_t* data = malloc(max_size);
+    if(!data){
+        fclose(file);
+        return false;
+    }
+    size_t size = fread(data,1,max_size,file);
     fclose(file);
-    return 1;
+    bool loaded = lc3_load_image(vm,data,size);
+    free(data);
+    return loaded;
+}
+
+uint16_t lc3_get_reg(const lc3_vm* vm,int r){
+    if(r < 0 || r >= R_COUNT)
+        return 0;
+    return vm->reg[r];
+}
+
+void lc3_set_reg(lc3_vm* vm,int r,uint16_t val){
+    if(r < 0 || r >= R_COUNT)
+        return;
+    vm->reg[r] = val;
+}
+
+uint16_t lc3_peek(const lc3_vm* vm,uint16_t address){
+    return vm->memory[address];
+}
+
+void lc3_poke(lc3_vm* vm,uint16_t address,uint16_t val){
+    vm->memory[address] = val;
 }
@@ -1,21 +1,8 @@
 #ifndef _VMCORE_H
 #define _VMCORE_H
-#ifdef _WIN32
-/* windows only */
-#include <Windows.h>
-#include <conio.h>
-#else
-/* unix only */
-#include <stdlib.h>
-#include <unistd.h>
-#include <fcntl.h>
-#include <sys/time.h>
-#include <sys/types.h>
-#include <sys/termios.h>
-#include <sys/mman.h>
-#endif
+#include <stdbool.h>
 #include <stdint.h>
-#include <stdio.h>
+#include "lc3.h"
 /* Memory map of the LC-3
   0x0000 -> 0x00FF Trap Vector Table 
   0x0100 -> 0x01FF Interrupt Vector Table
@@ -26,20 +13,20 @@
 //defining memory for the LC3 VM
 #define MEMORY_MAX (1 << 16)
 
-//defining CPU registers for the LC3 VM
+//short register names used inside the VM , the public ones are prefixed
 enum
-{ 
-    R_R0 = 0,
-    R_R1,
-    R_R2,
-    R_R3,
-    R_R4,
-    R_R5,
-    R_R6,
-    R_R7,
-    R_PC, /* program counter */
-    R_COND,
-    R_COUNT
+{
+    R_R0 = LC3_R_R0,
+    R_R1 = LC3_R_R1,
+    R_R2 = LC3_R_R2,
+    R_R3 = LC3_R_R3,
+    R_R4 = LC3_R_R4,
+    R_R5 = LC3_R_R5,
+    R_R6 = LC3_R_R6,
+    R_R7 = LC3_R_R7,
+    R_PC = LC3_R_PC, /* program counter */
+    R_COND = LC3_R_COND,
+    R_COUNT = LC3_R_COUNT
 };
 
 //condition flags for the R_COND register
@@ -94,31 +81,30 @@ enum
     MR_KBDR = 0xFE02  /* keyboard data */
 };
 //Declaring core Hardware components of the vm
+//every instance carries its own copy so several VMs can live in one process
+struct lc3_vm
+{
+    uint16_t memory[MEMORY_MAX];
+    uint16_t reg[R_COUNT];
+    lc3_io io;
+    //set once TRAP_IN printed its prompt so a retried IN does not print it again
+    bool in_prompted;
+    //set when a KBSR read found no pending key
+    bool kbsr_empty;
+};
+//Declaring Core functions of the VM (internal to libLC3 , hidden from hosts)
 
-extern uint16_t memory[MEMORY_MAX];
-extern uint16_t reg[R_COUNT];
-//Declaring Core functions of the VM
-
-// Handling input buffering from terminal (platform specific)
-void disable_input_buffering();
-void restore_input_buffering();
-uint16_t check_key();
-void handle_interrupt(int signal);
 //this extends the value x to a 16-bit value that is signed
-uint16_t sign_extend(uint16_t x , int bit_count);
+uint16_t lc3_sign_extend(uint16_t x , int bit_count);
 //update the condition flag register with each operation based on the DR
-void update_flags(uint16_t r);
+void lc3_update_flags(lc3_vm* vm,uint16_t r);
 //write to a specific memory address
-void mem_write(uint16_t address,uint16_t val);
+void lc3_mem_write(lc3_vm* vm,uint16_t address,uint16_t val);
 //reads from a specific memory address and handles
 //the read to MMRs
-uint16_t mem_read(uint16_t address);
-//this function swaps the 8 least significant bits with the
-//8 most significant bits because in little indian(which is what modern computers target)
-//the first byte is the least significant digit and big-indian(what LC-3 targets) which is it's the reverse
-uint16_t swap16(uint16_t x);
-//handles the copying of the binary into memory in the specified location (origin)
-void read_image_file(FILE* file);
-//manages the opening and closing of the binary file to be copied
-int read_image(const char* image_path);
+uint16_t lc3_mem_read(lc3_vm* vm,uint16_t address);
+//forwards output to the host write callback if there is one
+void lc3_vm_write(lc3_vm* vm,const char* data,size_t size);
+//fetches a pending input character from the host or LC3_NO_INPUT
+int lc3_vm_read_char(lc3_vm* vm);
 #endif
@@ -0,0 +1,188 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "lc3.h"
+
+//Checks the lc3_run stepping contract on tiny in-memory images.
+//Every image starts with its big-endian origin word like a real .obj file.
+
+static int failures = 0;
+
+#define CHECK(cond)                                                   \
+    do{                                                               \
+        if(!(cond)){                                                  \
+            printf("%s:%d: check failed: %s\n",__FILE__,__LINE__,#cond); \
+            ++failures;                                               \
+        }                                                             \
+    }while(0)
+
+//host side of the console : a queue of keys and everything written so far
+typedef struct
+{
+    const char* keys;
+    char out[256];
+    size_t out_len;
+} console;
+
+static int console_read_char(void* user){
+    console* c = user;
+    if(!c->keys || !*c->keys)
+        return LC3_NO_INPUT;
+    return (unsigned char)*c->keys++;
+}
+
+static void console_write(void* user,const char* data,size_t size){
+    console* c = user;
+    if(c->out_len + size > sizeof(c->out))
+        size = sizeof(c->out) - c->out_len;
+    memcpy(c->out + c->out_len,data,size);
+    c->out_len += size;
+}
+
+static lc3_vm* create_vm(console* c,const uint8_t* image,size_t size){
+    lc3_vm* vm = lc3_create();
+    memset(c,0,sizeof(*c));
+    lc3_io io = {c,console_read_char,console_write};
+    lc3_set_io(vm,&io);
+    lc3_load_image(vm,image,size);
+    return vm;
+}
+
+static void test_zero_budget(){
+    static const uint8_t image[] = {0x30,0x00, 0xF0,0x25}; /* HALT */
+    console c;
+    lc3_vm* vm = create_vm(&c,image,sizeof(image));
+    CHECK(lc3_run(vm,0) == LC3_EVENT_BUDGET);
+    CHECK(lc3_get_reg(vm,LC3_R_PC) == 0x3000);
+    CHECK(lc3_run(vm,1) == LC3_EVENT_HALT);
+    CHECK(lc3_get_reg(vm,LC3_R_PC) == 0x3001);
+    lc3_destroy(vm);
+}
+
+static void test_getc_rewinds(){
+    static const uint8_t image[] = {0x30,0x00, 0xF0,0x20, 0xF0,0x25}; /* GETC , HALT */
+    console c;
+    lc3_vm* vm = create_vm(&c,image,sizeof(image));
+    CHECK(lc3_run(vm,100) == LC3_EVENT_INPUT);
+    CHECK(lc3_get_reg(vm,LC3_R_PC) == 0x3000);
+    CHECK(lc3_run(vm,100) == LC3_EVENT_INPUT);
+    CHECK(lc3_get_reg(vm,LC3_R_PC) == 0x3000);
+    c.keys = "a";
+    CHECK(lc3_run(vm,100) == LC3_EVENT_TRAP);
+    CHECK(lc3_get_reg(vm,LC3_R_R0) == 'a');
+    CHECK(lc3_get_reg(vm,LC3_R_PC) == 0x3001);
+    CHECK(lc3_run(vm,100) == LC3_EVENT_HALT);
+    lc3_destroy(vm);
+}
+
+static void test_in_prompts_once(){
+    static const uint8_t image[] = {0x30,0x00, 0xF0,0x23, 0xF0,0x25}; /* IN , HALT */
+    static const char prompt[] = "Enter a Character : ";
+    console c;
+    lc3_vm* vm = create_vm(&c,image,sizeof(image));
+    CHECK(lc3_run(vm,100) == LC3_EVENT_INPUT);
+    CHECK(lc3_run(vm,100) == LC3_EVENT_INPUT);
+    CHECK(lc3_get_reg(vm,LC3_R_PC) == 0x3000);
+    CHECK(c.out_len == sizeof(prompt) - 1);
+    c.keys = "b";
+    CHECK(lc3_run(vm,100) == LC3_EVENT_TRAP);
+    CHECK(lc3_get_reg(vm,LC3_R_R0) == 'b');
+    CHECK(c.out_len == sizeof(prompt) && memcmp(c.out,"Enter a Character : b",c.out_len) == 0);
+    lc3_destroy(vm);
+}
+
+static void test_kbsr_poll(){
+    /* LDI R0 , #1 (reads KBSR through the pointer below) , HALT , .FILL xFE00 */
+    static const uint8_t image[] = {0x30,0x00, 0xA0,0x01, 0xF0,0x25, 0xFE,0x00};
+    console c;
+    lc3_vm* vm = create_vm(&c,image,sizeof(image));
+    CHECK(lc3_run(vm,100) == LC3_EVENT_POLL);
+    CHECK(lc3_get_reg(vm,LC3_R_PC) == 0x3001);
+    CHECK(lc3_get_reg(vm,LC3_R_R0) == 0);
+    lc3_set_reg(vm,LC3_R_PC,0x3000);
+    c.keys = "k";
+    CHECK(lc3_run(vm,100) == LC3_EVENT_HALT);
+    CHECK(lc3_get_reg(vm,LC3_R_R0) == 0x8000);
+    CHECK(lc3_peek(vm,0xFE02) == 'k');
+    lc3_destroy(vm);
+}
+
+static void test_illegal_opcodes(){
+    static const uint8_t image[] = {0x30,0x00, 0x80,0x00, 0xD0,0x00}; /* RTI , reserved */
+    console c;
+    lc3_vm* vm = create_vm(&c,image,sizeof(image));
+    CHECK(lc3_run(vm,100) == LC3_EVENT_ILLEGAL);
+    CHECK(lc3_get_reg(vm,LC3_R_PC) == 0x3001);
+    CHECK(lc3_run(vm,100) == LC3_EVENT_ILLEGAL);
+    CHECK(lc3_get_reg(vm,LC3_R_PC) == 0x3002);
+    lc3_destroy(vm);
+}
+
+static void test_load_image(){
+    /* origin xFFFE with four words , only two fit below the top of memory */
+    static const uint8_t image[] = {0xFF,0xFE, 0x12,0x34, 0x56,0x78, 0x9A,0xBC, 0xDE,0xF0};
+    lc3_vm* vm = lc3_create();
+    CHECK(!lc3_load_image(vm,image,1));
+    CHECK(lc3_load_image(vm,image,sizeof(image)));
+    CHECK(lc3_peek(vm,0xFFFE) == 0x1234);
+    CHECK(lc3_peek(vm,0xFFFF) == 0x5678);
+    CHECK(lc3_peek(vm,0x0000) == 0);
+    CHECK(lc3_peek(vm,0x0001) == 0);
+    lc3_destroy(vm);
+}
+
+//writes size bytes of data to path , returns false if the file could not be written
+static bool write_file(const char* path,const uint8_t* data,size_t size){
+    FILE* file = fopen(path,"wb");
+    if(!file)
+        return false;
+    bool written = fwrite(data,1,size,file) == size;
+    fclose(file);
+    return written;
+}
+
+static void test_load_image_file(){
+    static const char path[] = "lc3_test_image.obj";
+    static const uint8_t image[] = {0x30,0x00, 0x12,0x34, 0x56,0x78};
+    lc3_vm* vm = lc3_create();
+    CHECK(!lc3_load_image_file(vm,"lc3_test_missing.obj"));
+    CHECK(write_file(path,image,0));
+    CHECK(!lc3_load_image_file(vm,path));
+    CHECK(write_file(path,image,1));
+    CHECK(!lc3_load_image_file(vm,path));
+    CHECK(write_file(path,image,sizeof(image)));
+    CHECK(lc3_load_image_file(vm,path));
+    CHECK(lc3_peek(vm,0x3000) == 0x1234);
+    CHECK(lc3_peek(vm,0x3001) == 0x5678);
+    remove(path);
+    lc3_destroy(vm);
+}
+
+static void test_register_bounds(){
+    lc3_vm* vm = lc3_create();
+    lc3_set_reg(vm,LC3_R_COUNT,0xFFFF);
+    lc3_set_reg(vm,-1,0xFFFF);
+    CHECK(lc3_get_reg(vm,LC3_R_COUNT) == 0);
+    CHECK(lc3_get_reg(vm,-1) == 0);
+    CHECK(lc3_get_reg(vm,LC3_R_PC) == 0x3000);
+    lc3_destroy(vm);
+}
+
+int main(){
+    test_zero_budget();
+    test_getc_rewinds();
+    test_in_prompts_once();
+    test_kbsr_poll();
+    test_illegal_opcodes();
+    test_load_image();
+    test_load_image_file();
+    test_register_bounds();
+    if(failures){
+        printf("%d check(s) failed\n",failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,249 @@
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+//Starts LC3_SERVER (path in argv[1]) on a temporary unix socket and talks
+//to it like clients would. The served image echoes every key followed by a
+//per-session count of keys ('a' -> "a1") , halts on 'q' , spins forever
+//without output on 'c' and floods the console with PUTS on 'p'.
+
+static int failures = 0;
+
+#define CHECK(cond)                                                   \
+    do{                                                               \
+        if(!(cond)){                                                  \
+            printf("%s:%d: check failed: %s\n",__FILE__,__LINE__,#cond); \
+            ++failures;                                               \
+        }                                                             \
+    }while(0)
+
+//big-endian words , origin first , hand assembled:
+//LOOP GETC , ADD R3,R0,#0 , OUT , LD R1,COUNT , ADD R1,R1,#1 , ST R1,COUNT ,
+//     LD R2,ZERO , ADD R0,R1,R2 , OUT , then compare R3 with 'q' 'c' 'p'
+//QUIT HALT   SPIN BR SPIN   FLOOD LEA R0,MSG , PUTS , BR FLOOD
+static const uint16_t echo_image[] = {
+    0x3000,
+    0xF020,0x1620,0xF021,0x2214,0x1261,0x3212,0x2412,0x1042,0xF021,
+    0x2410,0x14C2,0x0407,0x240E,0x14C2,0x0405,0x240C,0x14C2,0x0403,0x0FED,
+    0xF025,0x0FFF,0xE007,0xF022,0x0FFD,
+    0x0000,0x0030,0xFF8F,0xFF9D,0xFF90 /* COUNT , ZERO , -'q' , -'c' , -'p' */
+};
+enum {FLOOD_LEN = 64, TIMEOUT_MS = 5000};
+
+static char dir[] = "/tmp/lc3_server_test.XXXXXX";
+static char image_path[128];
+static char socket_path[128];
+static pid_t server_pid = -1;
+
+static int64_t now_ms(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static bool write_image(){
+    FILE* file = fopen(image_path,"wb");
+    if(!file)
+        return false;
+    size_t count = sizeof(echo_image) / sizeof(echo_image[0]);
+    for(size_t i = 0; i < count; ++i){
+        fputc(echo_image[i] >> 8,file);
+        fputc(echo_image[i] & 0xFF,file);
+    }
+    //the PUTS message : FLOOD_LEN 'x' and its terminator
+    for(int i = 0; i < FLOOD_LEN; ++i){
+        fputc(0,file);
+        fputc('x',file);
+    }
+    fputc(0,file);
+    fputc(0,file);
+    return fclose(file) == 0;
+}
+
+static bool start_server(const char* server){
+    server_pid = fork();
+    if(server_pid < 0)
+        return false;
+    if(server_pid == 0){
+        int null_fd = open("/dev/null",O_WRONLY);
+        dup2(null_fd,STDOUT_FILENO);
+        char address[160];
+        snprintf(address,sizeof(address),"unix:%s",socket_path);
+        execl(server,server,"-t","2",address,image_path,(char*)NULL);
+        _exit(127);
+    }
+    return true;
+}
+
+static int connect_client(){
+    struct sockaddr_un addr;
+    memset(&addr,0,sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path,socket_path);
+    //the server may still be starting up
+    int64_t deadline = now_ms() + TIMEOUT_MS;
+    while(now_ms() < deadline){
+        int fd = socket(AF_UNIX,SOCK_STREAM | SOCK_CLOEXEC,0);
+        if(fd < 0)
+            return -1;
+        if(connect(fd,(struct sockaddr*)&addr,sizeof(addr)) == 0)
+            return fd;
+        close(fd);
+        usleep(10000);
+    }
+    return -1;
+}
+
+static bool send_str(int fd,const char* text){
+    return send(fd,text,strlen(text),MSG_NOSIGNAL) == (ssize_t)strlen(text);
+}
+
+//reads exactly strlen(expected) bytes and compares them
+static bool expect(int fd,const char* expected){
+    size_t len = strlen(expected);
+    char buf[256];
+    size_t got = 0;
+    int64_t deadline = now_ms() + TIMEOUT_MS;
+    while(got < len){
+        struct pollfd pfd = {fd,POLLIN,0};
+        int64_t left = deadline - now_ms();
+        if(left <= 0 || poll(&pfd,1,(int)left) <= 0)
+            break;
+        ssize_t n = recv(fd,buf + got,len - got,0);
+        if(n <= 0)
+            break;
+        got += (size_t)n;
+    }
+    if(got != len || memcmp(buf,expected,len) != 0){
+        printf("expected \"%s\" , got %zu byte(s) \"%.*s\"\n",expected,got,(int)got,buf);
+        return false;
+    }
+    return true;
+}
+
+//discards output until the server closes the connection
+static bool wait_eof(int fd){
+    char buf[4096];
+    int64_t deadline = now_ms() + TIMEOUT_MS;
+    for(;;){
+        struct pollfd pfd = {fd,POLLIN,0};
+        int64_t left = deadline - now_ms();
+        if(left <= 0 || poll(&pfd,1,(int)left) <= 0)
+            return false;
+        ssize_t n = recv(fd,buf,sizeof(buf),0);
+        if(n == 0)
+            return true;
+        if(n < 0)
+            return errno == ECONNRESET;
+    }
+}
+
+//cpu time used by the server so far , in ms
+static int64_t server_cpu_ms(){
+    char path[64];
+    snprintf(path,sizeof(path),"/proc/%d/stat",(int)server_pid);
+    FILE* file = fopen(path,"r");
+    if(!file)
+        return -1;
+    char line[1024];
+    size_t n = fread(line,1,sizeof(line) - 1,file);
+    fclose(file);
+    line[n] = '\0';
+    //fields after the parenthesised command name , utime and stime are 14 and 15
+    char* p = strrchr(line,')');
+    unsigned long utime = 0,stime = 0;
+    if(!p || sscanf(p + 2,"%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",&utime,&stime) != 2)
+        return -1;
+    return (int64_t)(utime + stime) * 1000 / sysconf(_SC_CLK_TCK);
+}
+
+static void test_getc_round_trip_and_isolation(){
+    int a = connect_client();
+    int b = connect_client();
+    CHECK(a >= 0 && b >= 0);
+    CHECK(send_str(a,"a") && expect(a,"a1"));
+    //b has its own memory , its count starts over
+    CHECK(send_str(b,"b") && expect(b,"b1"));
+    CHECK(send_str(a,"z") && expect(a,"z2"));
+    CHECK(send_str(b,"y") && expect(b,"y2"));
+    CHECK(send_str(a,"q") && expect(a,"q3VM Halted\n"));
+    CHECK(wait_eof(a));
+    CHECK(send_str(b,"x") && expect(b,"x3"));
+    close(a);
+    close(b);
+}
+
+static void test_hung_up_client_is_closed(){
+    //the program spins without output or input after 'c' , once the client
+    //hangs up nothing can ever stop it so the server has to drop the session
+    int c = connect_client();
+    CHECK(c >= 0);
+    CHECK(send_str(c,"c") && expect(c,"c1"));
+    shutdown(c,SHUT_WR);
+    CHECK(wait_eof(c));
+    close(c);
+}
+
+static void test_half_closed_slow_reader(){
+    //the program floods output to a client that half-closed and stops reading :
+    //the session must wait for the socket to drain without spinning
+    int d = connect_client();
+    CHECK(d >= 0);
+    CHECK(send_str(d,"p") && expect(d,"p1"));
+    shutdown(d,SHUT_WR);
+    usleep(500000);
+    int64_t before = server_cpu_ms();
+    usleep(1000000);
+    int64_t used = server_cpu_ms() - before;
+    CHECK(before >= 0 && used < 250);
+    close(d);
+    //the server keeps serving new clients afterwards
+    int e = connect_client();
+    CHECK(e >= 0 && send_str(e,"a") && expect(e,"a1"));
+    close(e);
+}
+
+int main(int argc,char* argv[]){
+    if(argc < 2){
+        printf("server_test [path to LC3_SERVER]\n");
+        return 1;
+    }
+    signal(SIGPIPE,SIG_IGN);
+    if(!mkdtemp(dir)){
+        printf("failed to create a temporary directory\n");
+        return 1;
+    }
+    snprintf(image_path,sizeof(image_path),"%s/echo.obj",dir);
+    snprintf(socket_path,sizeof(socket_path),"%s/lc3.sock",dir);
+    if(!write_image() || !start_server(argv[1])){
+        printf("failed to start the server\n");
+        return 1;
+    }
+    test_getc_round_trip_and_isolation();
+    test_hung_up_client_is_closed();
+    test_half_closed_slow_reader();
+
+    kill(server_pid,SIGTERM);
+    waitpid(server_pid,NULL,0);
+    unlink(socket_path);
+    unlink(image_path);
+    rmdir(dir);
+    if(failures){
+        printf("%d check(s) failed\n",failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}